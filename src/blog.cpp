@@ -1,6 +1,12 @@
 #include <filesystem>
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <mutex>
+#include <condition_variable>
+#include <array>
+#include <cstdio>
+#include <cstring>
 #include <chrono>
 #include <thread>
 #include <memory>
@@ -15,14 +21,383 @@
 
 #include "blog.h"
 
+namespace fs = std::filesystem;
+
+struct LogRecord {
+    enum class Kind : uint8_t { Access, Error };
+
+    Kind kind;
+    bool cache_hit;
+    uint16_t status;
+    uint32_t latency_us;
+    uint64_t bytes;
+    const char* level; // string literal, Error records only
+    std::chrono::system_clock::time_point time;
+    char text[256];    // route for Access, message for Error
+};
+
+// Single-producer single-consumer ring. Each request thread owns one and the
+// log writer thread is the only consumer, so neither side ever blocks.
+// 256 records of ~288 bytes is ~72KB per logging thread.
+class LogRing {
+public:
+    static constexpr size_t kCapacity = 256;
+
+    template <typename Fill>
+    bool push(Fill&& fill) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == kCapacity) {
+            return false;
+        }
+        fill(records_[tail % kCapacity]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename Sink>
+    void drain(Sink&& sink) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            sink(records_[head % kCapacity]);
+        }
+        head_.store(head, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<LogRecord, kCapacity> records_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+// Size-rotated append-only log file: path, path.1, ..., path.<max_files>.
+class RotatingLogFile {
+public:
+    ~RotatingLogFile() { close(); }
+
+    bool open(const std::string& path, uint64_t max_size, int max_files) {
+        path_ = path;
+        max_size_ = max_size;
+        max_files_ = max_files;
+        return reopen();
+    }
+
+    void write(const std::string& data) {
+        if (!file_ || data.empty()) {
+            return;
+        }
+        fwrite(data.data(), 1, data.size(), file_);
+        fflush(file_);
+        size_ += data.size();
+        if (max_size_ > 0 && size_ >= max_size_) {
+            rotate();
+        }
+    }
+
+    void close() {
+        if (file_) {
+            fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+private:
+    bool reopen() {
+        file_ = fopen(path_.c_str(), "ab");
+        if (!file_) {
+            return false;
+        }
+        std::error_code ec;
+        auto current = fs::file_size(path_, ec);
+        size_ = ec ? 0 : current;
+        return true;
+    }
+
+    void rotate() {
+        close();
+        std::error_code ec;
+        if (max_files_ > 0) {
+            fs::remove(path_ + "." + std::to_string(max_files_), ec);
+            for (int i = max_files_ - 1; i >= 1; --i) {
+                fs::rename(path_ + "." + std::to_string(i),
+                           path_ + "." + std::to_string(i + 1), ec);
+            }
+            fs::rename(path_, path_ + ".1", ec);
+        } else {
+            fs::remove(path_, ec);
+        }
+        reopen();
+    }
+
+    std::string path_;
+    FILE* file_ = nullptr;
+    uint64_t size_ = 0;
+    uint64_t max_size_ = 0;
+    int max_files_ = 0;
+};
+
+struct LogSettings {
+    bool access_log = true;
+    std::string access_log_file = "access.log";
+    std::string error_log_file = "error.log";
+    double sample_rate = 1.0;
+    uint64_t max_size = 10 * 1024 * 1024;
+    int max_files = 5;
+};
+
+// Request threads push records into their own LogRing; a background thread
+// batches them into the access and error logs. Records that don't fit in a
+// full ring are counted and reported instead of blocking the request.
+class AsyncLogger {
+public:
+    void start(const LogSettings& settings) {
+        settings_ = settings;
+        if (settings.sample_rate >= 1.0) {
+            sample_threshold_ = std::numeric_limits<uint64_t>::max();
+        } else if (settings.sample_rate <= 0.0) {
+            sample_threshold_ = 0;
+        } else {
+            sample_threshold_ = static_cast<uint64_t>(settings.sample_rate * 18446744073709551616.0);
+        }
+        if (settings.access_log &&
+            !access_file_.open(settings.access_log_file, settings.max_size, settings.max_files)) {
+            std::cerr << "无法打开访问日志: " << settings.access_log_file << "\n";
+            settings_.access_log = false;
+        }
+        if (!error_file_.open(settings.error_log_file, settings.max_size, settings.max_files)) {
+            std::cerr << "无法打开错误日志: " << settings.error_log_file << "\n";
+        }
+        running_ = true;
+        writer_ = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        wake_.notify_one();
+        writer_.join();
+        flush();
+        access_file_.close();
+        error_file_.close();
+    }
+
+    bool access_enabled() const {
+        return running_.load(std::memory_order_relaxed) && settings_.access_log;
+    }
+
+    void access(std::string_view route, int status, uint32_t latency_us,
+                uint64_t bytes, bool cache_hit) {
+        if (!access_enabled() || !sampled()) {
+            return;
+        }
+        bool pushed = local_ring().push([&](LogRecord& r) {
+            r.kind = LogRecord::Kind::Access;
+            r.status = static_cast<uint16_t>(status);
+            r.latency_us = latency_us;
+            r.bytes = bytes;
+            r.cache_hit = cache_hit;
+            r.time = std::chrono::system_clock::now();
+            copy_text(r.text, route);
+        });
+        if (!pushed) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void error(const char* level, std::string_view message) {
+        if (!running_.load(std::memory_order_relaxed)) {
+            std::cerr << "[" << level << "] " << message << "\n";
+            return;
+        }
+        bool pushed = local_ring().push([&](LogRecord& r) {
+            r.kind = LogRecord::Kind::Error;
+            r.level = level;
+            r.time = std::chrono::system_clock::now();
+            copy_text(r.text, message);
+        });
+        if (!pushed) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static void copy_text(char (&dst)[256], std::string_view src) {
+        constexpr std::string_view marker = "...";
+        if (src.size() < sizeof(dst)) {
+            memcpy(dst, src.data(), src.size());
+            dst[src.size()] = '\0';
+            return;
+        }
+        size_t n = sizeof(dst) - 1 - marker.size();
+        memcpy(dst, src.data(), n);
+        memcpy(dst + n, marker.data(), marker.size());
+        dst[sizeof(dst) - 1] = '\0';
+    }
+
+    bool sampled() const {
+        if (sample_threshold_ == std::numeric_limits<uint64_t>::max()) {
+            return true;
+        }
+        // xorshift64, seeded per thread
+        thread_local uint64_t state =
+            reinterpret_cast<uintptr_t>(&state) ^ 0x9E3779B97F4A7C15ULL;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state < sample_threshold_;
+    }
+
+    LogRing& local_ring() {
+        thread_local std::shared_ptr<LogRing> ring;
+        if (!ring) {
+            ring = std::make_shared<LogRing>();
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings_.push_back(ring);
+        }
+        return *ring;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        while (running_) {
+            wake_.wait_for(lock, std::chrono::milliseconds(25));
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    void flush() {
+        std::vector<std::shared_ptr<LogRing>> rings;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            // Drop rings whose threads have exited and that have nothing left.
+            rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                        [](const std::shared_ptr<LogRing>& r) {
+                                            return r.use_count() == 1 && r->empty();
+                                        }),
+                         rings_.end());
+            rings = rings_;
+        }
+
+        access_batch_.clear();
+        error_batch_.clear();
+        for (const auto& ring : rings) {
+            ring->drain([this](const LogRecord& r) { format(r); });
+        }
+
+        uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            error_batch_ += "[" + format_timestamp(std::chrono::system_clock::now()) +
+                            "] [WARNING] 日志缓冲区已满，丢弃 " + std::to_string(dropped) + " 条记录\n";
+        }
+
+        access_file_.write(access_batch_);
+        error_file_.write(error_batch_);
+    }
+
+    void format(const LogRecord& r) {
+        char line[384];
+        int n;
+        if (r.kind == LogRecord::Kind::Access) {
+            n = snprintf(line, sizeof(line), "[%s] %u %uus %lluB %s %s\n",
+                         format_timestamp(r.time).c_str(),
+                         static_cast<unsigned>(r.status),
+                         static_cast<unsigned>(r.latency_us),
+                         static_cast<unsigned long long>(r.bytes),
+                         r.cache_hit ? "hit" : "miss",
+                         r.text);
+        } else {
+            n = snprintf(line, sizeof(line), "[%s] [%s] %s\n",
+                         format_timestamp(r.time).c_str(), r.level, r.text);
+        }
+        if (n <= 0) {
+            return;
+        }
+        std::string& batch = r.kind == LogRecord::Kind::Access ? access_batch_ : error_batch_;
+        batch.append(line, std::min(static_cast<size_t>(n), sizeof(line) - 1));
+    }
+
+    static std::string format_timestamp(std::chrono::system_clock::time_point time) {
+        std::time_t t = std::chrono::system_clock::to_time_t(time);
+        std::tm tm{};
+        localtime_r(&t, &tm);
+        char buffer[32];
+        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+        return std::string(buffer);
+    }
+
+    LogSettings settings_;
+    uint64_t sample_threshold_ = std::numeric_limits<uint64_t>::max();
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::thread writer_;
+
+    RotatingLogFile access_file_;
+    RotatingLogFile error_file_;
+    std::string access_batch_;
+    std::string error_batch_;
+};
+
+AsyncLogger logger;
+
+// Forwards Crow's own log output into the async pipeline instead of stderr.
+class CrowLogHandler : public crow::ILogHandler {
+public:
+    void log(const std::string& message, crow::LogLevel level) override {
+        logger.error(level_name(level), message);
+    }
+
+private:
+    static const char* level_name(crow::LogLevel level) {
+        switch (level) {
+            case crow::LogLevel::Debug:    return "DEBUG";
+            case crow::LogLevel::Info:     return "INFO";
+            case crow::LogLevel::Warning:  return "WARNING";
+            case crow::LogLevel::Error:    return "ERROR";
+            case crow::LogLevel::Critical: return "CRITICAL";
+        }
+        return "INFO";
+    }
+};
+
+// Times each request and records it in the access log.
+struct AccessLogMiddleware {
+    struct context {
+        std::chrono::steady_clock::time_point start;
+        bool cache_hit = false;
+    };
+
+    void before_handle(crow::request&, crow::response&, context& ctx) {
+        ctx.start = std::chrono::steady_clock::now();
+    }
+
+    void after_handle(crow::request& req, crow::response& res, context& ctx) {
+        if (!logger.access_enabled()) {
+            return;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - ctx.start);
+        logger.access(req.url, res.code, static_cast<uint32_t>(elapsed.count()),
+                      res.body.size(), ctx.cache_hit);
+    }
+};
+
 void logError(const std::string& func, const std::string& file, int line) {
-    const std::string RED = "\033[31m";
-    const std::string RESET = "\033[0m";
-    std::cerr << RED << "In " << func << "() in " << file << " line " << line << ":" << RESET << std::endl;
+    logger.error("ERROR", "In " + func + "() in " + file + " line " + std::to_string(line));
 }
 
-namespace fs = std::filesystem;
-
 struct BlogPost {
     std::string title;
     std::string content;
@@ -42,10 +417,102 @@ struct BlogConfig {
     int port;
     bool hot_reload;
     int reload_interval;
+    LogSettings log;
+};
+
+// Open-addressing table from request path (without the leading '/') to the
+// cached post. Rebuilt under cache_mutex whenever posts_cache changes, so the
+// post route can resolve a string_view without allocating or hashing a
+// std::string. Keys are owned by the table; post pointers stay valid because
+// unordered_map nodes are stable until erased, which always triggers a rebuild.
+class PostRouteTable {
+public:
+    void rebuild(const std::unordered_map<std::string, BlogPost>& posts) {
+        slots_.clear();
+        keys_.clear();
+        min_len_ = std::numeric_limits<size_t>::max();
+        max_len_ = 0;
+
+        size_t capacity = 8;
+        while (capacity < posts.size() * 2) {
+            capacity <<= 1;
+        }
+        slots_.assign(capacity, Slot{});
+        mask_ = capacity - 1;
+
+        size_t total = 0;
+        for (const auto& [url, _] : posts) {
+            total += url.size();
+        }
+        keys_.reserve(total);
+
+        for (const auto& [url, post] : posts) {
+            std::string_view key(url);
+            if (!key.empty() && key.front() == '/') {
+                key.remove_prefix(1);
+            }
+
+            Slot slot;
+            slot.hash = hash(key);
+            slot.offset = static_cast<uint32_t>(keys_.size());
+            slot.length = static_cast<uint32_t>(key.size());
+            slot.post = &post;
+            keys_.append(key.data(), key.size());
+
+            size_t i = slot.hash & mask_;
+            while (slots_[i].post) {
+                i = (i + 1) & mask_;
+            }
+            slots_[i] = slot;
+
+            min_len_ = std::min(min_len_, key.size());
+            max_len_ = std::max(max_len_, key.size());
+        }
+    }
+
+    const BlogPost* find(std::string_view path) const {
+        if (path.size() < min_len_ || path.size() > max_len_) {
+            return nullptr;
+        }
+        uint64_t h = hash(path);
+        for (size_t i = h & mask_; slots_[i].post; i = (i + 1) & mask_) {
+            const Slot& slot = slots_[i];
+            if (slot.hash == h &&
+                std::string_view(keys_.data() + slot.offset, slot.length) == path) {
+                return slot.post;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        const BlogPost* post = nullptr;
+    };
+
+    // FNV-1a
+    static uint64_t hash(std::string_view s) {
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    std::vector<Slot> slots_;
+    std::string keys_;
+    size_t mask_ = 0;
+    size_t min_len_ = std::numeric_limits<size_t>::max();
+    size_t max_len_ = 0;
 };
 
 BlogConfig config;
 std::unordered_map<std::string, BlogPost> posts_cache;
+PostRouteTable post_routes;
 std::mutex cache_mutex;
 std::atomic<bool> should_run{true};
 std::unordered_map<std::string, fs::file_time_type> file_mod_times;
@@ -157,6 +624,16 @@ std::string html_escape(const std::string& s) {
     return r;
 }
 
+// Cheap shape check for post URLs, done before taking cache_mutex.
+bool is_post_request_path(std::string_view path) {
+    constexpr std::string_view ext = ".html";
+    if (path.size() <= ext.size() ||
+        path.compare(path.size() - ext.size(), ext.size(), ext) != 0) {
+        return false;
+    }
+    return path.find("..") == std::string_view::npos;
+}
+
 std::string format_time(const std::chrono::system_clock::time_point& time) {
     auto tt = std::chrono::system_clock::to_time_t(time);
     std::tm tm = *std::localtime(&tt);
@@ -334,6 +811,7 @@ std::string strip_front_matter(const std::string& content) {
 
 void update_cache() {
     std::unordered_set<std::string> seen_files;
+    bool cache_changed = false;
 
     for (const auto& entry : fs::recursive_directory_iterator(config.posts_directory)) {
         if (!entry.is_regular_file() || entry.path().extension() != ".md") {
@@ -420,6 +898,7 @@ void update_cache() {
                 posts_cache[url_path] = std::move(post);
                 file_mod_times[url_path] = current_mtime;
             }
+            cache_changed = true;
         }
     }
 
@@ -429,31 +908,54 @@ void update_cache() {
             if (seen_files.find(it->first) == seen_files.end()) {
                 file_mod_times.erase(it->first);
                 it = posts_cache.erase(it);
+                cache_changed = true;
             } else {
                 ++it;
             }
         }
+        if (cache_changed) {
+            post_routes.rebuild(posts_cache);
+        }
     }
 }
 
-static void write_log(const char* msg) {
-        std::ofstream logfile("./program_crash.log", std::ios::app);
-        if (logfile.is_open()) {
-            std::time_t t = std::time(nullptr);
-            char timestamp[100];
-            std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
-            logfile << "[" << timestamp << "] " << msg << std::endl;
-            logfile.close();
-        }
+static int crash_log_fd = -1;
+
+// Called from sighandle, so it must stay async-signal-safe: the descriptor is
+// opened once in register_signal() and the record goes straight to write(2).
+static void write_log(const char* msg, size_t len) {
+    if (crash_log_fd < 0) {
+        return;
+    }
+    char prefix[32];
+    char digits[20];
+    size_t n = 0;
+    unsigned long long t = static_cast<unsigned long long>(std::time(nullptr));
+    do {
+        digits[n++] = static_cast<char>('0' + t % 10);
+        t /= 10;
+    } while (t > 0 && n < sizeof(digits));
+    size_t pos = 0;
+    prefix[pos++] = '[';
+    while (n > 0) {
+        prefix[pos++] = digits[--n];
+    }
+    prefix[pos++] = ']';
+    prefix[pos++] = ' ';
+    write(crash_log_fd, prefix, pos);
+    write(crash_log_fd, msg, len);
 }
 
 static void sighandle(int sig) {
     const char msg[] = "Fatal error: signal received. Exiting.\n";
     write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    write_log(msg, sizeof(msg) - 1);
     _exit(127);
 }
 
 void register_signal() {
+    crash_log_fd = open("./program_crash.log", O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
     std::signal(SIGSEGV, sighandle);
     std::signal(SIGABRT, sighandle);
     std::signal(SIGFPE,  sighandle);
@@ -473,6 +975,12 @@ void load_config() {
         config.port = config_toml->get_as<int>("port").value_or(5444);
         config.hot_reload = config_toml->get_as<bool>("hot_reload").value_or(true);
         config.reload_interval = config_toml->get_as<int>("reload_interval").value_or(5);
+        config.log.access_log = config_toml->get_as<bool>("access_log").value_or(true);
+        config.log.access_log_file = config_toml->get_as<std::string>("access_log_file").value_or("access.log");
+        config.log.error_log_file = config_toml->get_as<std::string>("error_log_file").value_or("error.log");
+        config.log.sample_rate = config_toml->get_as<double>("access_log_sample_rate").value_or(1.0);
+        config.log.max_size = static_cast<uint64_t>(config_toml->get_as<int>("log_max_size_mb").value_or(10)) * 1024 * 1024;
+        config.log.max_files = config_toml->get_as<int>("log_max_files").value_or(5);
     } catch (const std::exception& e) {
         std::cerr << "配置文件加载失败: " << e.what() << std::endl;
         exit(1);
@@ -492,11 +1000,16 @@ int main() {
     #endif
     cmark_gfm_core_extensions_ensure_registered();
     load_config();
+    logger.start(config.log);
+
+    CrowLogHandler crow_log_handler;
+    crow::logger::setHandler(&crow_log_handler);
 
     {
         std::lock_guard<std::mutex> lock(cache_mutex);
         posts_cache.clear();
         file_mod_times.clear();
+        post_routes.rebuild(posts_cache);
     }
 
     update_cache();
@@ -506,7 +1019,10 @@ int main() {
         reload_thread = std::thread(hot_reload_thread);
     }
 
-    crow::SimpleApp app;
+    crow::App<AccessLogMiddleware> app;
+    // Per-request output belongs to the access log; error.log only gets
+    // Crow's warnings and errors.
+    app.loglevel(crow::LogLevel::Warning);
 
     CROW_ROUTE(app, "/")
     ([]() {
@@ -521,32 +1037,22 @@ int main() {
     });
 
     CROW_ROUTE(app, "/<path>")
-    ([](const std::string& path) {
-        if (path.empty()) {
+    ([&app](const crow::request& req, const std::string& path) {
+        std::string_view request_path(path);
+        if (!is_post_request_path(request_path)) {
             return crow::response(400); // Bad Request
         }
 
-        fs::path user_path(path);
-        fs::path normalized = user_path.lexically_normal();
-
-        if (path.find("..") != std::string::npos) {
-            return crow::response(400);
-        }
-
-        if (user_path.extension() != ".html") {
-            return crow::response(400);
-        }
-
-        std::string url_path = "/" + path;
         std::lock_guard<std::mutex> lock(cache_mutex);
-        auto it = posts_cache.find(url_path);
-        if (it != posts_cache.end()) {
+        const BlogPost* post = post_routes.find(request_path);
+        if (post) {
+            app.get_context<AccessLogMiddleware>(req).cache_hit = true;
             std::string full_html = string_format(HTML_TEMPLATE,
-                html_escape(it->second.title).c_str(),
+                html_escape(post->title).c_str(),
                 html_escape(config.blog_name).c_str(),
                 html_escape(config.blog_name).c_str(),
                 html_escape(config.blog_description).c_str(),
-                it->second.html.c_str()
+                post->html.c_str()
             );
             return crow::response(full_html);
         }
@@ -650,5 +1156,6 @@ int main() {
         reload_thread.join();
     }
 
+    logger.stop();
     return 0;
 }